@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace tkz::gomoku {
+
+// heap allocations made by the current thread, only counted when built with GOMOKU_COUNT_ALLOCATIONS
+inline thread_local ::std::size_t allocations = 0;
+// guards that have seen an allocation, kept so that the check does not depend on assert
+inline thread_local ::std::size_t violations = 0;
+
+// asserts that the current thread does not allocate during the lifetime of the guard
+struct NoAllocationGuard {
+	::std::size_t before = allocations;
+
+	~NoAllocationGuard() {
+		if (allocations != before) {
+			++violations;
+		}
+		assert(allocations == before && "the search must not allocate");
+	}
+};
+
+}
+
+// every executable is a single translation unit, so the replacement operators are defined once
+#ifdef GOMOKU_COUNT_ALLOCATIONS
+void* operator new(::std::size_t size) {
+	++::tkz::gomoku::allocations;
+	if (void* ptr = ::std::malloc(size ? size : 1)) {
+		return ptr;
+	}
+	throw ::std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept { ::std::free(ptr); }
+void operator delete(void* ptr, ::std::size_t) noexcept { ::std::free(ptr); }
+#endif
@@ -0,0 +1,85 @@
+#include "board.hpp"
+#include "allocation.hpp"
+#include "player/minimax.hpp"
+#include "player/mcts.hpp"
+
+#include <cstdlib>
+#include <string_view>
+#include <vector>
+#include <fmt/core.h>
+
+#ifndef GOMOKU_COUNT_ALLOCATIONS
+#error "gomoku-check must be built with GOMOKU_COUNT_ALLOCATIONS"
+#endif
+
+// Plays a few moves with both engines, including wins proven by the solver, and fails if any search allocates.
+// Unlike the assert in NoAllocationGuard, this also works in release builds.
+int main() {
+	using namespace ::std;
+	using namespace ::tkz::gomoku;
+
+	{
+		// make sure the counting operator new is the one in use, or every check below would pass trivially,
+		// it is called directly because a new expression may be optimised away
+		auto before = allocations;
+		void* volatile probe = ::operator new(1);
+		::operator delete(probe);
+		if (allocations == before) {
+			::fmt::println(stderr, "allocations are not counted");
+			return EXIT_FAILURE;
+		}
+	}
+
+	bool failed = false;
+	auto play = [&](string_view name, Player& player, vector<Step> steps) {
+		for (int i = 0; i < 4; ++i) {
+			auto before = violations;
+			Side side = alter(steps.back().side);
+			auto pos = get<Position>(player.decide(steps));
+			if (violations != before) {
+				::fmt::println(stderr, "{} allocated while searching move {}", name, steps.size() + 1);
+				failed = true;
+			}
+			steps.push_back({ .side = side, .pos = pos });
+			if (Board::fromSteps(steps).isWinningPos(pos)) {
+				break;
+			}
+		}
+	};
+	vector<Step> const opening{
+		{ .side = Black{}, .pos = {7, 7} },
+		{ .side = White{}, .pos = {7, 8} },
+		{ .side = Black{}, .pos = {8, 8} },
+	};
+	// black wins by continuous fours, which the solver proves before any search
+	vector<Step> const proven{
+		{ .side = Black{}, .pos = {7, 7} },
+		{ .side = White{}, .pos = {0, 0} },
+		{ .side = Black{}, .pos = {7, 8} },
+		{ .side = White{}, .pos = {0, 2} },
+		{ .side = Black{}, .pos = {8, 6} },
+		{ .side = White{}, .pos = {0, 4} },
+		{ .side = Black{}, .pos = {9, 6} },
+		{ .side = White{}, .pos = {0, 6} },
+		{ .side = Black{}, .pos = {10, 6} },
+		{ .side = White{}, .pos = {11, 6} },
+	};
+
+	MinimaxPlayer minimax;
+	play("minimax", minimax, opening);
+	play("minimax", minimax, proven);
+	MCTSPlayer mcts;
+	mcts.times = 20000;
+	play("mcts", mcts, opening);
+	play("mcts", mcts, proven);
+	// a tree too small for the iterations has to be pruned
+	MCTSPlayer pruned;
+	pruned.times = 20000;
+	pruned.memoryLimit = 1 << 20;
+	play("mcts with pruning", pruned, opening);
+
+	if (failed) {
+		return EXIT_FAILURE;
+	}
+	::fmt::println("no allocations while searching");
+}
@@ -1,21 +1,59 @@
 #include "board.hpp"
+#include "allocation.hpp"
 #include "player/base.hpp"
 #include "player/minimax.hpp"
+#include "record.hpp"
 #include "ui.hpp"
 
 #include <memory>
+#include <optional>
 #include <vector>
 #include <cstdlib>
 
-int main() {
+int main(int argc, char* argv[]) {
 	using namespace ::std;
 	using namespace ::tkz::gomoku;
 
+	record::Game game;
+	auto engine = make_unique<MinimaxPlayer>();
+	if (argc > 1) {
+		// evaluate with the network in the given weights file instead of the patterns
+		engine->eval = minimax::NeuralEvaluator{minimax::Network::load(argv[1])};
+	}
+	game.header.players[Side{White{}}.index()] = {
+		.kind = record::Kind::minimax,
+		.neural = argc > 1,
+		.strength = static_cast<uint32_t>(engine->depth),
+	};
+	auto async = make_unique<AsyncPlayer>(move(engine));
+	async->stats = &game.header.stats[Side{White{}}.index()];
 	unique_ptr<Player> blackPlayer = make_unique<UIPlayer>();
-	unique_ptr<Player> whitePlayer = make_unique<AsyncPlayer>(make_unique<MinimaxPlayer>());
+	unique_ptr<Player> whitePlayer = move(async);
 	vector<Step> steps;
 
+	// games are appended to the record file named by GOMOKU_RECORDS, if any
+	optional<record::Writer> writer;
+	if (auto path = getenv("GOMOKU_RECORDS")) {
+		writer.emplace(path);
+	}
+	auto save = [&](record::Result result) {
+		if (writer) {
+			game.finish(result);
+			writer->append(game);
+		}
+	};
+	auto winner = [](Side side) {
+		return visit(
+			overloaded{
+				make_matcher<Black>(record::Result::black),
+				make_matcher<White>(record::Result::white),
+			},
+			side
+		);
+	};
+
 	InitWindow(width, height, "Gomoku");
+	SetTargetFPS(fps);
 	while (!WindowShouldClose()) {
 		BeginDrawing();
 		drawBoard();
@@ -29,11 +67,17 @@ int main() {
 			},
 			side
 		).get()->decide(steps);
+		if (WindowShouldClose()) {
+			// the UI player gives up when the window is closed, which is not a result of the game
+			break;
+		}
 		visit(
 			[&]<typename Op>(Op op) {
 				if constexpr (is_same_v<Op, Position>) {
 					steps.push_back({ .side = side, .pos = op });
+					game.play(op);
 					if (Board::fromSteps(steps).isWinningPos(op)) {
+						save(winner(side));
 						BeginDrawing();
 						drawBoard();
 						drawSteps(steps);
@@ -46,9 +90,12 @@ int main() {
 					if (steps.size() >= 2) {
 						steps.pop_back();
 						steps.pop_back();
+						game.retract();
+						game.retract();
 					}
 				}
 				if constexpr (is_same_v<Op, GiveUp>) {
+					save(winner(alter(side)));
 					WaitTime(5);
 					exit(EXIT_SUCCESS);
 				}
@@ -56,4 +103,5 @@ int main() {
 			op
 		);
 	}
+	save(record::Result::unfinished);
 }
\ No newline at end of file
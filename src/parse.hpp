@@ -0,0 +1,21 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace tkz::gomoku {
+
+// the whole text as a number, or nothing if any of it is not part of one
+template <typename T>
+::std::optional<T> parse(::std::string_view text) {
+	T value{};
+	auto [end, error] = ::std::from_chars(text.data(), text.data() + text.size(), value);
+	if (error != ::std::errc{} || end != text.data() + text.size()) {
+		return ::std::nullopt;
+	}
+	return value;
+}
+
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "board.hpp"
+#include "player/progress.hpp"
 
 #include <variant>
 #include <span>
@@ -15,6 +16,8 @@ using Operation = ::std::variant<Position, Retract, GiveUp>;
 struct Player {
 	virtual ~Player() = default;
 	virtual Operation decide(::std::span<Step const> steps) = 0;
+	// search progress published while deciding, null if the player does not report any
+	virtual Channel<Progress>* progress() { return nullptr; }
 };
 
 }
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "board.hpp"
+#include "player/minimax/zobrist.hpp"
+#include "player/progress.hpp"
+#include "player/threats.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace tkz::gomoku::dfpn {
+
+using Number = ::std::uint32_t;
+
+// sums of two numbers never overflow
+inline constexpr Number infinity = ::std::numeric_limits<Number>::max() / 2;
+
+inline Number add(Number a, Number b) { return ::std::min(a + b, infinity); }
+
+// Depth-first proof-number search for a win by continuous fours (VCF) of the attacker.
+// Proof and disproof numbers are stored as (phi, delta) of the side to move, in a fixed size table replaced on collision.
+struct Solver {
+	struct Entry {
+		::std::uint_fast64_t hash;
+		Number phi, delta;
+	};
+
+	::std::vector<Entry> table = ::std::vector<Entry>(1 << 18, {0, 1, 1});
+	minimax::Zobrist zobrist{::std::mt19937_64{}};
+	::std::uint64_t nodeLimit = 200000;
+	// a node takes tens of microseconds, the limits are checked often enough to stop within a few milliseconds
+	::std::uint64_t checkInterval = 64;
+
+	Board board;
+	::std::uint_fast64_t hash = 0;
+	Side attacker = Black{};
+	::std::uint64_t nodes = 0;
+	::std::chrono::steady_clock::time_point deadline;
+	bool stopped = false;
+	::std::optional<Position> winning;
+
+	using Moves = threats::Moves;
+
+	enum class Result {
+		open,
+		win,
+		loss,
+	};
+
+	Entry& slot(::std::uint_fast64_t hash) { return table[hash % table.size()]; }
+
+	::std::pair<Number, Number> lookup(::std::uint_fast64_t hash) {
+		auto&& entry = slot(hash);
+		return entry.hash == hash ? ::std::pair{entry.phi, entry.delta} : ::std::pair<Number, Number>{1, 1};
+	}
+
+	void store(Number phi, Number delta) { slot(hash) = {hash, phi, delta}; }
+
+	void place(Side side, Position pos) {
+		board[pos] = threats::cellOf(side);
+		hash ^= zobrist(side, pos);
+	}
+
+	void remove(Side side, Position pos) {
+		board[pos] = ::std::monostate{};
+		hash ^= zobrist(side, pos);
+	}
+
+	Result generate(Side side, Moves& moves) {
+		if (!threats::fives(board, side, 1).empty()) {
+			return Result::win;
+		}
+		auto blocks = threats::fives(board, alter(side), 2);
+		if (blocks.size() >= 2) {
+			return Result::loss;
+		}
+		if (blocks.size() == 1) {
+			// the only move is to block
+			moves = blocks;
+			return Result::open;
+		}
+		if (side != attacker) {
+			// the attacker has lost the initiative
+			return Result::win;
+		}
+		moves = threats::fours(board, side);
+		return moves.empty() ? Result::loss : Result::open;
+	}
+
+	void mid(Side side, Number thphi, Number thdelta, int ply) {
+		if (++nodes % checkInterval == 0) {
+			stopped = nodes >= nodeLimit || ::std::chrono::steady_clock::now() >= deadline;
+		}
+		Moves moves;
+		switch (generate(side, moves)) {
+			case Result::win:
+				store(0, infinity);
+				return;
+			case Result::loss:
+				store(infinity, 0);
+				return;
+			case Result::open:
+				break;
+		}
+		while (!stopped) {
+			Number phi = infinity;
+			Number delta = 0;
+			Number secondDelta = infinity;
+			Number bestPhi = 0;
+			::std::size_t best = 0;
+			for (::std::size_t i = 0; i < moves.size(); ++i) {
+				place(side, moves[i]);
+				auto [childPhi, childDelta] = lookup(hash);
+				remove(side, moves[i]);
+				delta = add(delta, childPhi);
+				if (childDelta < phi) {
+					secondDelta = phi;
+					phi = childDelta;
+					bestPhi = childPhi;
+					best = i;
+				}
+				else if (childDelta < secondDelta) {
+					secondDelta = childDelta;
+				}
+			}
+			store(phi, delta);
+			if (phi >= thphi || delta >= thdelta) {
+				if (ply == 0 && phi == 0) {
+					winning = moves[best];
+				}
+				return;
+			}
+			place(side, moves[best]);
+			mid(alter(side), add(thdelta - delta, bestPhi), ::std::min(thphi, add(secondDelta, 1)), ply + 1);
+			remove(side, moves[best]);
+		}
+	}
+
+	// a winning move of side if it is proven within the budget
+	::std::optional<Position> solve(Board const& board, Side side, ::std::chrono::steady_clock::time_point deadline = ::std::chrono::steady_clock::time_point::max()) {
+		::std::ranges::fill(table, Entry{0, 1, 1});
+		this->board = board;
+		this->hash = 0;
+		for (int i = 0; i < rows * cols; ++i) {
+			auto pos = Position::fromIndex(i);
+			::std::visit(
+				overloaded{
+					[&](Black) { this->hash ^= zobrist(Black{}, pos); },
+					[&](White) { this->hash ^= zobrist(White{}, pos); },
+					[](::std::monostate) {},
+				},
+				board[pos]
+			);
+		}
+		this->attacker = side;
+		this->nodes = 0;
+		this->deadline = deadline;
+		this->stopped = false;
+		this->winning = ::std::nullopt;
+		if (auto five = threats::fives(this->board, side, 1); !five.empty()) {
+			return five.front();
+		}
+		mid(side, infinity, infinity, 0);
+		return winning;
+	}
+};
+
+// How the engines use the solver: before searching they try to prove a win within a short time, and a proven move is
+// published as a one move principal variation so that the overlay and the game records still see the work.
+struct Prover {
+	Solver solver;
+	::std::chrono::milliseconds time{50};
+
+	::std::optional<Position> prove(Board const& board, Side side, ::std::chrono::steady_clock::time_point deadline, Channel<Progress>& channel, double score) {
+		using namespace ::std::chrono;
+		auto start = steady_clock::now();
+		auto pos = solver.solve(board, side, ::std::min(deadline, start + time));
+		if (pos) {
+			double seconds = duration<double>(steady_clock::now() - start).count();
+			Progress report{ .depth = 1, .score = score, .nodes = solver.nodes, .nps = seconds > 0 ? solver.nodes / seconds : 0.0 };
+			report.pv.push_back(*pos);
+			channel.publish(report);
+		}
+		return pos;
+	}
+};
+
+}
@@ -1,19 +1,23 @@
 #pragma once
 
 #include "board.hpp"
+#include "allocation.hpp"
 #include "player/base.hpp"
 #include "player/minimax/evaluator.hpp"
+#include "player/minimax/neural.hpp"
+#include "player/dfpn.hpp"
 
-#include <memory>
 #include <cmath>
+#include <cstdint>
 #include <numbers>
 #include <vector>
-#include <unordered_map>
 #include <variant>
 #include <algorithm>
 #include <random>
 #include <optional>
+#include <chrono>
 #include <fmt/core.h>
+#include <boost/container/static_vector.hpp>
 
 namespace tkz::gomoku {
 
@@ -36,138 +40,297 @@ struct MCTSPlayer : public Player {
 		return nullopt;
 	}
 
-	static ::std::vector<Position> getChoices(Board const& board) {
-		::std::vector<Position> choices;
+	using Choices = ::boost::container::static_vector<::std::uint8_t, rows * cols>;
+
+	static Choices getChoices(Board const& board) {
+		Choices choices;
 		for (int i = 0; i < rows * cols; ++i) {
 			auto pos = Position::fromIndex(i);
 			if (::std::holds_alternative<::std::monostate>(board[pos])) {
-				choices.push_back(pos);
+				choices.push_back(i);
 			}
 		}
 		return choices;
 	}
 
-	struct Node : public ::std::enable_shared_from_this<Node> {
-		::std::weak_ptr<Node> parent;
-		::std::unordered_map<int, ::std::shared_ptr<Node>> children;
+	static constexpr int none = -1;
+	static constexpr int released = -2; // parent of a slot in the free list
+
+	// nodes live in a pool and refer to each other by index, so that searching never allocates
+	struct Node {
+		int parent;
+		int firstChild;
+		int nextSibling;
+		int index; // the cell played to reach this node
 		int visitTimes;
 		double quality;
-		Side const side;
-		Board const board;
-		bool const terminal;
-		::std::vector<Position> choices;
-
-		Node(Side side, Board const& board):
-			parent(),
-			children(),
-			visitTimes(0),
-			quality(0.0),
-			side(side),
-			board(board),
-			terminal(getWinner(board).has_value()),
-			choices(getChoices(board))
-		{ }
-
-		Node(::std::shared_ptr<Node> parent, Board const& board):
-			parent(parent),
-			children(),
-			visitTimes(0),
-			quality(0.0),
-			side(alter(parent->side)),
-			board(board),
-			terminal(getWinner(board).has_value()),
-			choices(getChoices(board))
-		{ }
-
-		::std::shared_ptr<Node> expand() {
-			static ::std::mt19937_64 gen{};
-			::std::shuffle(choices.begin(), choices.end(), gen);
-			Position pos = choices.back();
-			choices.pop_back();
-			Board nextBoard = this->board;
-			nextBoard[pos] = ::std::visit(
-				overloaded{
-					make_matcher<Black>(Cell{Black{}}),
-					make_matcher<White>(Cell{White{}}),
-				},
-				this->side
-			);
-			return children.emplace(
-				Position::toIndex(pos),
-				::std::make_shared<Node>(
-					shared_from_this(),
-					nextBoard
-				)
-			).first->second;
-		}
-
-		::std::shared_ptr<Node> bestUCT() const {
-			double bestScore = -::std::numeric_limits<double>::infinity();
-			::std::shared_ptr<Node> bestChild = nullptr;
-			for (auto&& [_, child] : this->children) {
-				double left = child->quality / child->visitTimes;
-				double right = 2.0 * ::std::log(this->visitTimes) / child->visitTimes;
-				double score = left + 1.0 / ::std::numbers::sqrt2 * right;
-				if (score > bestScore) {
-					bestScore = score;
-					bestChild = child;
+		Side side;
+		Board board;
+		bool terminal;
+		Choices choices;
+	};
+
+	::std::vector<Node> nodes;
+	// the tree never holds more nodes than fit in the limit, the least visited subtrees are pruned to make room
+	::std::size_t memoryLimit = ::std::size_t{256} << 20;
+	::std::size_t capacity = 0;
+	int freeList = none;
+	int live = 0;
+	::std::uint64_t recycled = 0;
+	bool exhausted = false; // the search has stopped early because nothing could be pruned
+	::std::vector<int> scratch;
+
+	int addNode(int parent, int index, Side side, Board const& board, bool terminal) {
+		int id = freeList != none ? freeList : static_cast<int>(nodes.size());
+		if (id == freeList) {
+			freeList = nodes[id].nextSibling;
+		}
+		else {
+			nodes.emplace_back();
+		}
+		++live;
+		Node& node = nodes[id] = Node{
+			.parent = parent,
+			.firstChild = none,
+			.nextSibling = none,
+			.index = index,
+			.visitTimes = 0,
+			.quality = 0.0,
+			.side = side,
+			.board = board,
+			.terminal = terminal,
+			.choices = getChoices(board),
+		};
+		node.terminal = node.terminal || node.choices.empty();
+		if (parent != none) {
+			node.nextSibling = nodes[parent].firstChild;
+			nodes[parent].firstChild = id;
+		}
+		return id;
+	}
+
+	bool full() const { return freeList == none && nodes.size() >= capacity; }
+
+	// Frees the subtrees of the least visited quarter of the nodes below the root children, their moves go back to
+	// the untried choices of their parents. The visits of a node never exceed those of its parent, so the nodes under
+	// the threshold form whole subtrees. Returns whether any node has been freed.
+	bool prune(int root) {
+		scratch.clear();
+		for (auto&& node : nodes) {
+			if (node.parent != none && node.parent != released && node.parent != root) {
+				scratch.push_back(node.visitTimes);
+			}
+		}
+		if (scratch.empty()) {
+			return false;
+		}
+		auto nth = scratch.begin() + scratch.size() / 4;
+		::std::ranges::nth_element(scratch, nth);
+		int threshold = *nth;
+		int before = live;
+		for (int id = 0; id < static_cast<int>(nodes.size()); ++id) {
+			if (nodes[id].parent == released || nodes[id].visitTimes <= threshold) continue;
+			for (int* link = &nodes[id].firstChild; *link != none;) {
+				int child = *link;
+				if (id == root || nodes[child].visitTimes > threshold) {
+					link = &nodes[child].nextSibling;
+					continue;
 				}
+				*link = nodes[child].nextSibling;
+				nodes[id].choices.push_back(nodes[child].index);
+				release(child);
 			}
-			return bestChild;
 		}
+		return live < before;
+	}
 
-		int bestIndex() const {
-			double bestScore = -::std::numeric_limits<double>::infinity();
-			int bestIndex = -1;
-			for (auto&& [index, child] : this->children) {
-				double score = child->quality / child->visitTimes;
-				if (score > bestScore) {
-					bestScore = score;
-					bestIndex = index;
-				}
+	void release(int id) {
+		scratch.clear();
+		scratch.push_back(id);
+		while (!scratch.empty()) {
+			int node = scratch.back();
+			scratch.pop_back();
+			for (int child = nodes[node].firstChild; child != none; child = nodes[child].nextSibling) {
+				scratch.push_back(child);
 			}
-			return bestIndex;
+			nodes[node].parent = released;
+			nodes[node].nextSibling = freeList;
+			freeList = node;
+			--live;
+			++recycled;
 		}
+	}
 
-		void backPropagate(double reward) {
-			this->visitTimes += 1;
-			this->quality += reward;
-			if (auto parent = this->parent.lock()) {
-				parent->backPropagate(-reward);
+	template <typename F>
+	void forEachChild(int id, F&& f) const {
+		for (int child = nodes[id].firstChild; child != none; child = nodes[child].nextSibling) {
+			f(nodes[child]);
+		}
+	}
+
+	::std::mt19937_64 gen{};
+
+	int expand(int id) {
+		auto& choices = nodes[id].choices;
+		auto it = choices.begin() + ::std::uniform_int_distribution<::std::size_t>{0, choices.size() - 1}(gen);
+		int index = *it;
+		*it = choices.back();
+		choices.pop_back();
+		Position pos = Position::fromIndex(index);
+		Board nextBoard = nodes[id].board;
+		nextBoard[pos] = ::std::visit(
+			overloaded{
+				make_matcher<Black>(Cell{Black{}}),
+				make_matcher<White>(Cell{White{}}),
+			},
+			nodes[id].side
+		);
+		return addNode(id, index, alter(nodes[id].side), nextBoard, nextBoard.isWinningPos(pos));
+	}
+
+	int bestUCT(int id) const {
+		double bestScore = -::std::numeric_limits<double>::infinity();
+		int bestChild = none;
+		int visitTimes = nodes[id].visitTimes;
+		for (int child = nodes[id].firstChild; child != none; child = nodes[child].nextSibling) {
+			double left = nodes[child].quality / nodes[child].visitTimes;
+			double right = 2.0 * ::std::log(visitTimes) / nodes[child].visitTimes;
+			double score = left + 1.0 / ::std::numbers::sqrt2 * right;
+			if (score > bestScore) {
+				bestScore = score;
+				bestChild = child;
 			}
 		}
-	};
+		return bestChild;
+	}
+
+	int bestChild(int id) const {
+		double bestScore = -::std::numeric_limits<double>::infinity();
+		int bestChild = none;
+		for (int child = nodes[id].firstChild; child != none; child = nodes[child].nextSibling) {
+			double score = nodes[child].quality / nodes[child].visitTimes;
+			if (score > bestScore) {
+				bestScore = score;
+				bestChild = child;
+			}
+		}
+		return bestChild;
+	}
+
+	void backPropagate(int id, double reward) {
+		for (; id != none; id = nodes[id].parent) {
+			nodes[id].visitTimes += 1;
+			nodes[id].quality += reward;
+			reward = -reward;
+		}
+	}
 
 	int times = 100000;
-	minimax::Evaluator eval;
+	int reportInterval = 1024;
+	// the search stops early at the deadline, checked every checkInterval iterations
+	int checkInterval = 64;
+	::std::chrono::steady_clock::time_point deadline = ::std::chrono::steady_clock::time_point::max();
+	dfpn::Prover prover;
+	minimax::AnyEvaluator eval;
+	Channel<Progress> channel;
+
+	Channel<Progress>* progress() override { return &channel; }
 
-	static ::std::shared_ptr<Node> select(::std::shared_ptr<Node> node) {
-		while (!node->terminal) {
-			if (node->choices.empty()) {
-				node = node->bestUCT();
+	void publish(int root, int iterations, ::std::chrono::steady_clock::time_point start) {
+		using namespace ::std::chrono;
+		Progress report{};
+		forEachChild(root, [&](Node const& child) {
+			report.visits[child.index] = child.visitTimes;
+		});
+		// the principal variation follows the most visited children
+		for (int id = root; nodes[id].firstChild != none && report.pv.size() < maxPrincipalVariation;) {
+			int most = nodes[id].firstChild;
+			for (int child = most; child != none; child = nodes[child].nextSibling) {
+				if (nodes[child].visitTimes > nodes[most].visitTimes) {
+					most = child;
+				}
+			}
+			report.pv.push_back(Position::fromIndex(nodes[most].index));
+			id = most;
+		}
+		if (int child = bestChild(root); child != none) {
+			report.score = nodes[child].quality / nodes[child].visitTimes;
+		}
+		report.depth = report.pv.size();
+		report.nodes = iterations;
+		double seconds = duration<double>(steady_clock::now() - start).count();
+		report.nps = seconds > 0 ? iterations / seconds : 0.0;
+		report.tree = {
+			.nodes = static_cast<::std::uint64_t>(live),
+			.bytes = live * sizeof(Node),
+			.recycled = recycled,
+			.exhausted = exhausted,
+		};
+		channel.publish(report);
+	}
+
+	int select(int id) {
+		while (!nodes[id].terminal) {
+			if (nodes[id].choices.empty()) {
+				id = bestUCT(id);
 			}
 			else {
-				return node->expand();
+				return expand(id);
 			}
 		}
-		return node;
+		return id;
 	}
 
-	double simulate(::std::shared_ptr<Node> node) const {
-		double ally = eval(node->board, alter(node->side));
-		double enemy = eval(node->board, node->side);
-		return ally - enemy;
+	double simulate(int id) {
+		return ::std::visit(
+			[&](auto& eval) {
+				eval.reset(nodes[id].board);
+				double ally = eval(nodes[id].board, alter(nodes[id].side));
+				double enemy = eval(nodes[id].board, nodes[id].side);
+				return ally - enemy;
+			},
+			eval
+		);
 	}
 
 	Operation decide(::std::span<const Step> steps) override {
 		Side side = steps.empty() ? Black{} : alter(steps.back().side);
-		::std::shared_ptr<Node> root = ::std::make_shared<Node>(side, Board::fromSteps(steps));
-		for (int i = 0; i < times; ++i) {
+		auto board = Board::fromSteps(steps);
+		// every iteration adds at most one node, the pool keeps its capacity between decisions. The children of the root
+		// are never pruned, so the pool holds at least as many nodes again below them even if that exceeds the limit.
+		::std::size_t least = 2 * (getChoices(board).size() + 1);
+		capacity = ::std::min<::std::size_t>(times + 1, ::std::max(least, memoryLimit / sizeof(Node)));
+		nodes.clear();
+		nodes.reserve(capacity);
+		scratch.reserve(capacity);
+		NoAllocationGuard _;
+		if (auto pos = prover.prove(board, side, deadline, channel, 0.0)) {
+			return *pos;
+		}
+		freeList = none;
+		live = 0;
+		recycled = 0;
+		exhausted = false;
+		int root = addNode(none, none, side, board, getWinner(board).has_value());
+		auto start = ::std::chrono::steady_clock::now();
+		int iterations = 0;
+		while (iterations < times) {
+			if (full() && !prune(root)) {
+				exhausted = true;
+				break;
+			}
 			auto expandNode = select(root);
 			double reward = simulate(expandNode);
-			expandNode->backPropagate(reward);
+			backPropagate(expandNode, reward);
+			if (++iterations % reportInterval == 0) {
+				publish(root, iterations, start);
+			}
+			if (iterations % checkInterval == 0 && ::std::chrono::steady_clock::now() >= deadline) {
+				break;
+			}
 		}
-		return Position::fromIndex(root->bestIndex());
+		publish(root, iterations, start);
+		return Position::fromIndex(nodes[bestChild(root)].index);
 	}
 };
 
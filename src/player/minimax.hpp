@@ -3,13 +3,20 @@
 #include "board.hpp"
 #include "player/base.hpp"
 #include "player/minimax/evaluator.hpp"
+#include "player/minimax/neural.hpp"
 #include "player/minimax/zobrist.hpp"
+#include "player/dfpn.hpp"
+#include "player/threats.hpp"
+#include "allocation.hpp"
 
 #include <functional>
 #include <vector>
 #include <random>
+#include <algorithm>
+#include <chrono>
 #include <unordered_map>
 #include <fmt/core.h>
+#include <boost/container/static_vector.hpp>
 
 namespace tkz::gomoku::minimax {
 
@@ -23,28 +30,127 @@ struct L {
 };
 
 struct MinimaxPlayer : public Player {
-	Evaluator eval;
+	AnyEvaluator eval;
 	Zobrist zobrist{::std::mt19937_64{::std::random_device{}()}};
-	int depth = 4;
+	int depth = 3;
 	int radius = 2;
+	// leaves are extended by forcing moves only, up to this many plies and nodes per leaf
+	int quiescenceDepth = 8;
+	int quiescenceNodes = 64;
+	Score window = 50000;
+	// the search stops at the deadline and falls back to the deepest completed iteration
+	::std::chrono::steady_clock::time_point deadline = ::std::chrono::steady_clock::time_point::max();
+	dfpn::Prover prover;
 
-	::std::unordered_map<::std::uint_fast64_t, Position> best{{0, {7, 7}}};
+	::std::unordered_map<::std::uint_fast64_t, double> cache;
+
+	static constexpr Position nowhere{-1, -1};
+
+	// best move of each searched position, a fixed size table replaced on collision so that searching never allocates
+	struct Entry {
+		::std::uint_fast64_t hash;
+		Position pos;
+	};
+
+	static constexpr ::std::size_t bestSize = 1 << 20;
+	::std::vector<Entry> best = ::std::vector<Entry>(bestSize, {0, nowhere});
+
+	Position findBest(::std::uint_fast64_t hash) const {
+		auto&& entry = best[hash & (bestSize - 1)];
+		return entry.hash == hash ? entry.pos : nowhere;
+	}
+
+	void updateBest(::std::uint_fast64_t hash, Position pos) {
+		best[hash & (bestSize - 1)] = {hash, pos};
+	}
+
+	Channel<Progress> channel;
+	::std::uint64_t reportInterval = 4096;
+	// a node can take a hundred microseconds to evaluate, so the clock is checked much more often than progress is sent
+	::std::uint64_t checkInterval = 64;
 
-	::std::unordered_map<::std::uint_fast64_t, Position>::iterator updateBest(::std::unordered_map<::std::uint_fast64_t, Position>::iterator it, ::std::uint_fast64_t hash, Position pos) {
-		if (it != best.end()) {
-			it->second = pos;
-			return it;
+	Channel<Progress>* progress() override { return &channel; }
+
+	// two killer moves per ply, counted from the root of the current decide
+	::std::vector<::std::array<Position, 2>> killers;
+	// how often a move has caused a cutoff, indexed by the side to move
+	::std::array<::std::array<int, rows * cols>, 2> history{};
+
+	void updateKiller(int depth, Position pos) {
+		auto& slots = killers[depth];
+		if (slots[0] != pos) {
+			slots[1] = slots[0];
+			slots[0] = pos;
 		}
-		return best.emplace(hash, pos).first;
 	}
 
-	::std::unordered_map<::std::uint_fast64_t, double> cache;
+	// drops the move ordering learnt in another game
+	void forget() {
+		killers.clear();
+		history = {};
+	}
+
+	void age() {
+		// the root moves two plies deeper between our turns
+		killers.erase(killers.begin(), killers.begin() + ::std::min<::std::size_t>(2, killers.size()));
+		killers.resize(depth + 1, {nowhere, nowhere});
+		for (auto&& table : history) {
+			for (auto&& value : table) {
+				value /= 2;
+			}
+		}
+	}
+
+	static constexpr Score infinity = 1 << 30;
+	static constexpr Score win = infinity - 256;
 
 	struct Searcher {
 		MinimaxPlayer* player;
 		Board board;
-		::std::vector<Step> steps;
+		::boost::container::static_vector<Step, rows * cols> steps;
 		::std::uint_fast64_t hash;
+		int limit = 0;
+		Position rootBest = nowhere;
+		bool stopped = false;
+		::std::uint64_t nodes = 0;
+		int quiesced = 0; // nodes extended below the current leaf
+		Progress report{};
+		::std::chrono::steady_clock::time_point start = ::std::chrono::steady_clock::now();
+
+		void publish() {
+			using namespace ::std::chrono;
+			double seconds = duration<double>(steady_clock::now() - start).count();
+			report.nodes = nodes;
+			report.nps = seconds > 0 ? nodes / seconds : 0.0;
+			player->channel.publish(report);
+		}
+
+		// follow the best moves from the root as far as the current iteration has searched
+		void updatePrincipalVariation() {
+			Board board = this->board;
+			auto hash = this->hash;
+			Side side = steps.empty() ? Black{} : alter(steps.back().side);
+			report.pv.clear();
+			while (report.pv.size() < static_cast<::std::size_t>(::std::min(limit, maxPrincipalVariation))) {
+				Position pos = report.pv.empty() ? rootBest : player->findBest(hash);
+				if (pos == nowhere || !::std::holds_alternative<::std::monostate>(board[pos])) {
+					break;
+				}
+				board[pos] = ::std::visit(
+					overloaded{
+						make_matcher<Black>(Cell{Black{}}),
+						make_matcher<White>(Cell{White{}}),
+					},
+					side
+				);
+				hash ^= player->zobrist(side, pos);
+				report.pv.push_back(pos);
+				if (board.isWinningPos(pos)) {
+					break;
+				}
+				side = alter(side);
+			}
+		}
 
 		auto doStep(Side side, Position pos) {
 			return L(
@@ -58,121 +164,246 @@ struct MinimaxPlayer : public Player {
 					);
 					steps.push_back({ .side = side, .pos = pos });
 					hash ^= player->zobrist(side, pos);
+					::std::visit([&](auto& eval) { eval.place(side, pos); }, player->eval);
 				},
 				[=, this] {
 					board[pos] = ::std::monostate{};
 					steps.pop_back();
 					hash ^= player->zobrist(side, pos);
+					::std::visit([&](auto& eval) { eval.remove(side, pos); }, player->eval);
 				}
 			);
 		}
 
-		double min(int depth, double alpha, double beta) {
-			Side side = steps.empty() ? Black{} : alter(steps.back().side);
-			if (depth == player->depth || !steps.empty() && board.isWinningPos(steps.back().pos)) {
-				double ally = player->eval(board, side);
-				double enemy = player->eval(board, alter(side));
-				double score = ally - enemy;
-				// ::fmt::println("{:016x} (depth={}) : {} = {} - {}", hash, depth, score, ally, enemy);
-				return score;
-			}
-			auto callMax = [&](Position pos) {
-				auto _ = doStep(side, pos);
-				return max(depth + 1, alpha, beta);
-			};
-			auto it = player->best.find(hash);
-			if (it != player->best.end() && ::std::holds_alternative<::std::monostate>(board[it->second])) {
-				// ::fmt::println("best first");
-				double score = callMax(it->second);
-				if (score < beta) {
-					beta = score;
-				}
-				if (alpha >= beta) {
-					// ::fmt::println("{:016x} (depth={}) pruning", hash, depth);
-					return beta;
-				}
+		using Moves = ::boost::container::static_vector<::std::pair<int, Position>, rows * cols>;
+
+		// candidate moves around the existing stones, killers first and then by history
+		Moves orderedSteps(Side side, int depth, Position hashMove) const {
+			Moves moves;
+			if (steps.empty()) {
+				moves.emplace_back(0, Position{rows / 2, cols / 2});
+				return moves;
 			}
+			::std::array<bool, rows * cols> seen{};
+			auto&& killers = player->killers[depth];
+			auto&& history = player->history[side.index()];
 			for (auto&& step : steps) {
 				for (int k = 1; k <= player->radius; ++k) {
 					for (auto&& d : directions) {
 						auto q = step.pos + k * d;
-						if (Position::valid(q) && ::std::holds_alternative<::std::monostate>(board[q])) {
-							double score = callMax(q);
-							if (score < beta) {
-								beta = score;
-								it = player->updateBest(it, hash, q);
-							}
-							if (alpha >= beta) {
-								// ::fmt::println("{:016x} (depth={}) pruning", hash, depth);
-								return beta;
-							}
+						if (!Position::valid(q) || q == hashMove || seen[Position::toIndex(q)] || !::std::holds_alternative<::std::monostate>(board[q])) {
+							continue;
 						}
+						seen[Position::toIndex(q)] = true;
+						int priority = q == killers[0] ? ::std::numeric_limits<int>::max()
+							: q == killers[1] ? ::std::numeric_limits<int>::max() - 1
+							: history[Position::toIndex(q)];
+						moves.emplace_back(priority, q);
 					}
 				}
 			}
-			return beta;
+			// std::stable_sort would allocate a temporary buffer
+			::std::sort(moves.begin(), moves.end(), [](auto&& a, auto&& b) { return a.first > b.first; });
+			return moves;
+		}
+
+		// counts a node, returns whether the deadline has passed
+		bool tick() {
+			if (++nodes % player->reportInterval == 0) {
+				publish();
+			}
+			if (nodes % player->checkInterval == 0) {
+				stopped = ::std::chrono::steady_clock::now() >= player->deadline;
+			}
+			return stopped;
 		}
 
-		double max(int depth, double alpha, double beta) {
+		Score evaluate(Side side) {
+			return ::std::visit(
+				[&](auto& eval) {
+					Score ally = eval(board, side);
+					Score enemy = eval(board, alter(side));
+					return ally - enemy;
+				},
+				player->eval
+			);
+		}
+
+		// Resolves fours left pending at a leaf: the side to move makes five if it can, blocks the only five of the
+		// other side, or else stands pat on the evaluation and tries each of its own fours. The previous move has not
+		// made five.
+		Score quiesce(int depth, Score alpha, Score beta) {
+			// the leaf itself has been counted by search
+			if (depth > limit && tick()) {
+				return 0;
+			}
+			Side side = alter(steps.back().side);
+			if (!threats::fives(board, side, 1).empty()) {
+				return win - depth - 1;
+			}
+			auto blocks = threats::fives(board, alter(side), 2);
+			if (blocks.size() >= 2) {
+				return -win + depth + 2;
+			}
+			bool extend = depth - limit < player->quiescenceDepth && quiesced < player->quiescenceNodes;
+			if (blocks.size() == 1 && extend) {
+				++quiesced;
+				auto _ = doStep(side, blocks.front());
+				return -quiesce(depth + 1, -beta, -alpha);
+			}
+			Score bestScore = evaluate(side);
+			if (blocks.size() == 1 || !extend || bestScore >= beta) {
+				return bestScore;
+			}
+			alpha = ::std::max(alpha, bestScore);
+			for (auto&& pos : threats::fours(board, side)) {
+				if (quiesced >= player->quiescenceNodes) {
+					break;
+				}
+				++quiesced;
+				Score score = [&] {
+					auto _ = doStep(side, pos);
+					return -quiesce(depth + 1, -beta, -alpha);
+				}();
+				if (stopped) {
+					return 0;
+				}
+				bestScore = ::std::max(bestScore, score);
+				alpha = ::std::max(alpha, score);
+				if (alpha >= beta) {
+					break;
+				}
+			}
+			return bestScore;
+		}
+
+		Score search(int depth, Score alpha, Score beta) {
+			if (tick()) {
+				return 0;
+			}
 			Side side = steps.empty() ? Black{} : alter(steps.back().side);
-			if (depth == player->depth || !steps.empty() && board.isWinningPos(steps.back().pos)) {
-				double ally = player->eval(board, side);
-				double enemy = player->eval(board, alter(side));
-				double score = ally - enemy;
-				// ::fmt::println("{:016x} (depth={}) : {} = {} - {}", hash, depth, score, ally, enemy);
-				return score;
+			if (!steps.empty() && board.isWinningPos(steps.back().pos)) {
+				// the previous move has made five, prefer the quickest win and the slowest loss
+				return -win + depth;
 			}
-			auto callMin = [&](Position pos) {
+			if (depth == limit) {
+				quiesced = 0;
+				return quiesce(depth, alpha, beta);
+			}
+			Score bestScore = -infinity;
+			bool first = true;
+			auto callSearch = [&](Position pos) {
 				auto _ = doStep(side, pos);
-				return min(depth + 1, alpha, beta);
+				if (first) {
+					return -search(depth + 1, -beta, -alpha);
+				}
+				// null window search, re-search only when the move might be better than the current one
+				Score score = -search(depth + 1, -alpha - 1, -alpha);
+				if (alpha < score && score < beta) {
+					score = -search(depth + 1, -beta, -alpha);
+				}
+				return score;
 			};
-			auto it = player->best.find(hash);
-			if (it != player->best.end() && ::std::holds_alternative<::std::monostate>(board[it->second])) {
-				// ::fmt::println("{:016x} (depth={}) best", hash, depth);
-				double score = callMin(it->second);
+			auto tryStep = [&](Position pos) {
+				Score score = callSearch(pos);
+				if (stopped) {
+					return true;
+				}
+				first = false;
+				if (score > bestScore) {
+					bestScore = score;
+				}
 				if (score > alpha) {
 					alpha = score;
+					player->updateBest(hash, pos);
+					if (depth == 0) {
+						rootBest = pos;
+					}
 				}
 				if (alpha >= beta) {
-					// ::fmt::println("{:016x} (depth={}) pruning", hash, depth);
-					return alpha;
+					player->updateKiller(depth, pos);
+					player->history[side.index()][Position::toIndex(pos)] += (limit - depth) * (limit - depth);
+					return true;
+				}
+				return false;
+			};
+			Position hashMove = depth == 0 && rootBest != nowhere ? rootBest : player->findBest(hash);
+			if (hashMove != nowhere && ::std::holds_alternative<::std::monostate>(board[hashMove])) {
+				if (tryStep(hashMove)) {
+					return bestScore;
 				}
 			}
-			for (auto&& step : steps) {
-				for (int k = 1; k <= player->radius; ++k) {
-					for (auto&& d : directions) {
-						auto q = step.pos + k * d;
-						if (Position::valid(q) && ::std::holds_alternative<::std::monostate>(board[q])) {
-							double score = callMin(q);
-							if (score > alpha) {
-								alpha = score;
-								it = player->updateBest(it, hash, q);
-							}
-							if (alpha >= beta) {
-								// ::fmt::println("{:016x} (depth={}) pruning", hash, depth);
-								return alpha;
-							}
-						}
-					}
+			else {
+				hashMove = nowhere;
+			}
+			for (auto&& [_, pos] : orderedSteps(side, depth, hashMove)) {
+				if (tryStep(pos)) {
+					return bestScore;
 				}
 			}
-			return alpha;
+			// no empty cell left, the game is a draw
+			return first ? 0 : bestScore;
 		}
 	};
 
 	Operation decide(::std::span<Step const> steps) override {
 		auto hash = this->zobrist(steps);
-		Searcher{
+		age();
+		channel.publish({});
+		Searcher searcher{
 			.player = this,
 			.board = Board::fromSteps(steps),
 			.steps{steps.begin(), steps.end()},
 			.hash = hash,
-		}.max(
-			0,
-			-::std::numeric_limits<double>::infinity(),
-			+::std::numeric_limits<double>::infinity()
-		);
-		return best.find(hash)->second;
+		};
+		Side side = steps.empty() ? Black{} : alter(steps.back().side);
+		NoAllocationGuard _;
+		if (auto pos = prover.prove(searcher.board, side, deadline, channel, win)) {
+			return *pos;
+		}
+		::std::visit([&](auto& eval) { eval.reset(searcher.board); }, eval);
+		// iterative deepening, each iteration searches within a window around the previous score
+		Score guess = 0;
+		Position completed = nowhere;
+		for (int limit = 1; limit <= depth && !searcher.stopped; ++limit) {
+			searcher.limit = limit;
+			Score delta = window;
+			Score alpha = limit == 1 ? -infinity : ::std::max(guess - delta, -infinity);
+			Score beta = limit == 1 ? +infinity : ::std::min(guess + delta, +infinity);
+			while (true) {
+				Score score = searcher.search(0, alpha, beta);
+				if (searcher.stopped) {
+					break;
+				}
+				delta = ::std::min(delta, infinity / 2) * 2;
+				if (score <= alpha && alpha > -infinity) {
+					alpha = ::std::max(score - delta, -infinity);
+				}
+				else if (score >= beta && beta < +infinity) {
+					beta = ::std::min(score + delta, +infinity);
+				}
+				else {
+					guess = score;
+					break;
+				}
+			}
+			if (searcher.stopped) {
+				break;
+			}
+			completed = searcher.rootBest;
+			searcher.report.depth = limit;
+			searcher.report.score = guess;
+			searcher.updatePrincipalVariation();
+			searcher.publish();
+		}
+		if (completed != nowhere) {
+			return completed;
+		}
+		if (searcher.rootBest != nowhere) {
+			return searcher.rootBest;
+		}
+		// stopped before any move has been searched
+		return searcher.orderedSteps(side, 0, nowhere).front().second;
 	}
 };
 
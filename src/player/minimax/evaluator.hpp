@@ -10,21 +10,23 @@
 
 namespace tkz::gomoku::minimax {
 
+using Score = int;
+
 struct Evaluator {
-	double 成五 = 50000000.0;
-	double 活四 = 1000000.0;
-	double 冲四 = 100000.0;
-	double 单活三 = 80000.0;
-	double 条活三 = 70000.0;
-	double 眠三 = 5000.0;
-	double 活二 = 500.0;
-	double 眠二 = 100.0;
+	Score 成五 = 50000000;
+	Score 活四 = 1000000;
+	Score 冲四 = 100000;
+	Score 单活三 = 80000;
+	Score 条活三 = 70000;
+	Score 眠三 = 5000;
+	Score 活二 = 500;
+	Score 眠二 = 100;
 
 	static inline const auto mappings = []{
 		using namespace ::std;
 		using Rule = string_view;
 		using RuleList = vector<Rule>;
-		using Mapping = pair<double Evaluator::*, RuleList>;
+		using Mapping = pair<Score Evaluator::*, RuleList>;
 		using MappingList = vector<Mapping>;
 
 		return MappingList{
@@ -114,7 +116,20 @@ struct Evaluator {
 		);
 	};
 
-	double operator()(Board const& board, Side side) const {
+	// the patterns are matched against the whole board, there is no state to follow the search
+	void reset(Board const&) {}
+	void place(Side, Position) {}
+	void remove(Side, Position) {}
+
+	static constexpr ::std::size_t patterns = 8;
+
+	// the score is linear in the weights, which lets the weights be tuned without matching the board again
+	struct Features {
+		Score position = 0;
+		::std::array<int, patterns> counts{};
+	};
+
+	static Features features(Board const& board, Side side) {
 		using namespace ::std;
 		using ::boost::container::static_vector;
 
@@ -123,6 +138,7 @@ struct Evaluator {
 			make_matcher<White>(holds_alternative<White>(side) ? 's' : 't'),
 			make_matcher<monostate>('e')
 		};
+		Features features;
 		auto evalPos = [&](Position pos){
 			array<static_vector<char, 9>, 4> lines;
 			for (int i = 0; i < 4; ++i) {
@@ -132,31 +148,37 @@ struct Evaluator {
 					lines[i].push_back(visit(toChar, board[q]));
 				}
 			}
-			double total = posScore(pos);
+			features.position += posScore(pos);
 			for (auto&& line : lines) {
 				auto contains = [line = string_view{line}](string_view rule) { return line.contains(rule); };
-				for (auto&& [member, rules] : mappings) {
-					if (ranges::any_of(rules, contains)) {
-						total += this->*member;
+				for (size_t i = 0; i < patterns; ++i) {
+					if (ranges::any_of(mappings[i].second, contains)) {
+						++features.counts[i];
 					}
 				}
 			}
-			return total;
 		};
-		return visit(
+		visit(
 			[&]<typename T>(T) {
-				double score = 0.0;
 				for (int x = 0; x < rows; ++x) {
 					for (int y = 0; y < cols; ++y) {
 						if (holds_alternative<T>(board[{x, y}])) {
-							score += evalPos({x, y});
+							evalPos({x, y});
 						}
 					}
 				}
-				return score;
 			},
 			side
 		);
+		return features;
+	}
+
+	Score operator()(Board const& board, Side side) const {
+		auto [score, counts] = features(board, side);
+		for (::std::size_t i = 0; i < patterns; ++i) {
+			score += counts[i] * this->*mappings[i].first;
+		}
+		return score;
 	}
 };
 
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "board.hpp"
+#include "player/minimax/evaluator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+
+// The AVX2 kernels are compiled on their own and chosen at runtime, so the rest of the program still runs on CPUs
+// without AVX2. Compilers without the target attribute only get them when the whole program is built for AVX2.
+#if defined(__AVX2__)
+#define GOMOKU_AVX2_KERNELS
+#define GOMOKU_AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GOMOKU_AVX2_KERNELS
+#define GOMOKU_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#ifdef GOMOKU_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace tkz::gomoku::minimax {
+
+// A quantised network with one hidden layer. Every cell has two input features per perspective, "own stone" and
+// "enemy stone", so the hidden layer can be accumulated incrementally as stones are placed and removed.
+//
+// Weights file, little endian:
+//   char magic[4] = "GNN1"
+//   int32 hidden, must match Network::hidden
+//   int32 scale, the score of an output of 1.0
+//   int16 weights[features][hidden], scaled by 127
+//   int16 bias[hidden], scaled by 127
+//   int8 output[2 * hidden], scaled by 64, own perspective first
+//   int32 outputBias, scaled by 127 * 64
+struct Network {
+	static constexpr int hidden = 128;
+	static constexpr int features = rows * cols * 2;
+	static constexpr int activation = 127;
+	static constexpr int weight = 64;
+
+	alignas(32) ::std::array<::std::array<::std::int16_t, hidden>, features> weights;
+	alignas(32) ::std::array<::std::int16_t, hidden> bias;
+	alignas(32) ::std::array<::std::int8_t, 2 * hidden> output;
+	::std::int32_t outputBias;
+	::std::int32_t scale;
+
+	static int feature(Side perspective, Side stone, Position pos) {
+		return Position::toIndex(pos) * 2 + (perspective == stone ? 0 : 1);
+	}
+
+	static ::std::shared_ptr<Network const> load(::std::filesystem::path const& path) {
+		::std::ifstream in{path, ::std::ios::binary};
+		auto read = [&](auto& value) {
+			if (!in.read(reinterpret_cast<char*>(&value), sizeof(value))) {
+				throw ::std::runtime_error{"truncated network file " + path.string()};
+			}
+		};
+		if (!in) {
+			throw ::std::runtime_error{"cannot open network file " + path.string()};
+		}
+		::std::array<char, 4> magic;
+		::std::int32_t size;
+		read(magic);
+		read(size);
+		if (magic != ::std::array{'G', 'N', 'N', '1'} || size != hidden) {
+			throw ::std::runtime_error{"unsupported network file " + path.string()};
+		}
+		auto network = ::std::make_shared<Network>();
+		read(network->scale);
+		read(network->weights);
+		read(network->bias);
+		read(network->output);
+		read(network->outputBias);
+		return network;
+	}
+};
+
+using Accumulator = ::std::array<::std::int16_t, Network::hidden>;
+
+namespace scalar {
+
+inline void addFeature(Accumulator& accumulator, Accumulator const& row) {
+	for (int i = 0; i < Network::hidden; ++i) accumulator[i] += row[i];
+}
+
+inline void subFeature(Accumulator& accumulator, Accumulator const& row) {
+	for (int i = 0; i < Network::hidden; ++i) accumulator[i] -= row[i];
+}
+
+inline ::std::int32_t propagate(Accumulator const& hidden, ::std::int8_t const* output) {
+	::std::int32_t sum = 0;
+	for (int i = 0; i < Network::hidden; ++i) {
+		sum += ::std::clamp<::std::int32_t>(hidden[i], 0, Network::activation) * output[i];
+	}
+	return sum;
+}
+
+}
+
+#ifdef GOMOKU_AVX2_KERNELS
+namespace avx2 {
+
+inline bool supported() {
+#ifdef __AVX2__
+	return true;
+#else
+	static bool const supported = [] {
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") != 0;
+	}();
+	return supported;
+#endif
+}
+
+GOMOKU_AVX2_TARGET inline void addFeature(Accumulator& accumulator, Accumulator const& row) {
+	for (int i = 0; i < Network::hidden; i += 16) {
+		auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(&accumulator[i]));
+		auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(&row[i]));
+		_mm256_store_si256(reinterpret_cast<__m256i*>(&accumulator[i]), _mm256_add_epi16(a, b));
+	}
+}
+
+GOMOKU_AVX2_TARGET inline void subFeature(Accumulator& accumulator, Accumulator const& row) {
+	for (int i = 0; i < Network::hidden; i += 16) {
+		auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(&accumulator[i]));
+		auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(&row[i]));
+		_mm256_store_si256(reinterpret_cast<__m256i*>(&accumulator[i]), _mm256_sub_epi16(a, b));
+	}
+}
+
+GOMOKU_AVX2_TARGET inline ::std::int32_t propagate(Accumulator const& hidden, ::std::int8_t const* output) {
+	auto const zero = _mm256_setzero_si256();
+	auto const top = _mm256_set1_epi16(Network::activation);
+	auto const ones = _mm256_set1_epi16(1);
+	auto sum = _mm256_setzero_si256();
+	for (int i = 0; i < Network::hidden; i += 32) {
+		auto a = _mm256_load_si256(reinterpret_cast<__m256i const*>(&hidden[i]));
+		auto b = _mm256_load_si256(reinterpret_cast<__m256i const*>(&hidden[i + 16]));
+		a = _mm256_min_epi16(_mm256_max_epi16(a, zero), top);
+		b = _mm256_min_epi16(_mm256_max_epi16(b, zero), top);
+		// packing works within 128-bit lanes, restore the order afterwards
+		auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0b11011000);
+		auto w = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(output + i));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(packed, w), ones));
+	}
+	auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0b01001110));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0b10110001));
+	return _mm_cvtsi128_si32(half);
+}
+
+}
+#endif
+
+inline void addFeature(Accumulator& accumulator, Accumulator const& row) {
+#ifdef GOMOKU_AVX2_KERNELS
+	if (avx2::supported()) return avx2::addFeature(accumulator, row);
+#endif
+	scalar::addFeature(accumulator, row);
+}
+
+inline void subFeature(Accumulator& accumulator, Accumulator const& row) {
+#ifdef GOMOKU_AVX2_KERNELS
+	if (avx2::supported()) return avx2::subFeature(accumulator, row);
+#endif
+	scalar::subFeature(accumulator, row);
+}
+
+// clipped ReLU of the hidden layer dotted with the int8 output weights
+inline ::std::int32_t propagate(Accumulator const& hidden, ::std::int8_t const* output) {
+#ifdef GOMOKU_AVX2_KERNELS
+	if (avx2::supported()) return avx2::propagate(hidden, output);
+#endif
+	return scalar::propagate(hidden, output);
+}
+
+// Keeps one accumulator per perspective, it has to be reset to the board before searching and follow every
+// placed and removed stone afterwards.
+struct NeuralEvaluator {
+	::std::shared_ptr<Network const> network;
+	alignas(32) ::std::array<Accumulator, 2> accumulators{};
+
+	explicit NeuralEvaluator(::std::shared_ptr<Network const> network): network(::std::move(network)) {
+		if (!this->network) {
+			throw ::std::invalid_argument{"a neural evaluator needs a network"};
+		}
+	}
+
+	void reset(Board const& board) {
+		for (auto&& accumulator : accumulators) {
+			accumulator = network->bias;
+		}
+		for (int i = 0; i < rows * cols; ++i) {
+			auto pos = Position::fromIndex(i);
+			::std::visit(
+				overloaded{
+					[&](Black) { this->place(Black{}, pos); },
+					[&](White) { this->place(White{}, pos); },
+					[](::std::monostate) {},
+				},
+				board[pos]
+			);
+		}
+	}
+
+	void place(Side side, Position pos) {
+		addFeature(accumulators[0], network->weights[Network::feature(Black{}, side, pos)]);
+		addFeature(accumulators[1], network->weights[Network::feature(White{}, side, pos)]);
+	}
+
+	void remove(Side side, Position pos) {
+		subFeature(accumulators[0], network->weights[Network::feature(Black{}, side, pos)]);
+		subFeature(accumulators[1], network->weights[Network::feature(White{}, side, pos)]);
+	}
+
+	Score operator()(Board const&, Side side) const {
+		auto&& own = accumulators[side.index()];
+		auto&& enemy = accumulators[alter(side).index()];
+		::std::int64_t sum = network->outputBias
+			+ propagate(own, network->output.data())
+			+ propagate(enemy, network->output.data() + Network::hidden);
+		return sum * network->scale / (Network::activation * Network::weight);
+	}
+};
+
+// the evaluator of a player, either the hand-weighted patterns or a network
+using AnyEvaluator = ::std::variant<Evaluator, NeuralEvaluator>;
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <boost/container/static_vector.hpp>
+
+namespace tkz::gomoku {
+
+inline constexpr int maxPrincipalVariation = 32;
+
+struct Progress {
+	int depth = 0;
+	double score = 0.0;
+	::std::uint64_t nodes = 0;
+	double nps = 0.0;
+	::boost::container::static_vector<Position, maxPrincipalVariation> pv;
+	// visit counts of the root children, only filled by MCTS
+	::std::array<int, rows * cols> visits{};
+	// size of the MCTS tree
+	struct {
+		::std::uint64_t nodes = 0;
+		::std::uint64_t bytes = 0;
+		::std::uint64_t recycled = 0;
+		bool exhausted = false; // stopped before the iterations or the deadline ran out
+	} tree;
+};
+
+// lock-free triple buffer, the producer never waits and the consumer always sees the latest complete value
+template <typename T>
+struct Channel {
+	static constexpr unsigned dirty = 4;
+
+	::std::array<T, 3> buffers{};
+	::std::atomic<unsigned> middle{1};
+	unsigned back = 0; // owned by the producer
+	unsigned front = 2; // owned by the consumer
+
+	void publish(T const& value) {
+		this->buffers[this->back] = value;
+		this->back = this->middle.exchange(this->back | dirty, ::std::memory_order_acq_rel) & ~dirty;
+	}
+
+	// returns whether a newer value has been published since the last call
+	bool update() {
+		if (!(this->middle.load(::std::memory_order_relaxed) & dirty)) {
+			return false;
+		}
+		this->front = this->middle.exchange(this->front, ::std::memory_order_acq_rel) & ~dirty;
+		return true;
+	}
+
+	T const& latest() const { return this->buffers[this->front]; }
+};
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <array>
+#include <cstddef>
+#include <boost/container/static_vector.hpp>
+
+namespace tkz::gomoku::threats {
+
+using Moves = ::boost::container::static_vector<Position, rows * cols>;
+
+inline Cell cellOf(Side side) {
+	return ::std::visit(
+		overloaded{
+			make_matcher<Black>(Cell{Black{}}),
+			make_matcher<White>(Cell{White{}}),
+		},
+		side
+	);
+}
+
+// the board is restored before returning
+inline bool makesFive(Board& board, Side side, Position pos) {
+	board[pos] = cellOf(side);
+	bool five = board.isWinningPos(pos);
+	board[pos] = ::std::monostate{};
+	return five;
+}
+
+// cells where side would make five, at most limit of them
+inline Moves fives(Board& board, Side side, ::std::size_t limit) {
+	Moves cells;
+	for (int i = 0; i < rows * cols && cells.size() < limit; ++i) {
+		auto pos = Position::fromIndex(i);
+		if (::std::holds_alternative<::std::monostate>(board[pos]) && makesFive(board, side, pos)) {
+			cells.push_back(pos);
+		}
+	}
+	return cells;
+}
+
+// cells where side would threaten to make five on its next move
+inline Moves fours(Board& board, Side side) {
+	Moves cells;
+	::std::array<bool, rows * cols> seen{};
+	for (int i = 0; i < rows * cols; ++i) {
+		auto stone = Position::fromIndex(i);
+		if (board[stone] != cellOf(side)) continue;
+		for (auto&& d : directions) {
+			for (int k = 1; k <= 4; ++k) {
+				auto pos = stone + k * d;
+				if (!Position::valid(pos) || seen[Position::toIndex(pos)] || !::std::holds_alternative<::std::monostate>(board[pos])) continue;
+				seen[Position::toIndex(pos)] = true;
+				board[pos] = cellOf(side);
+				bool four = false;
+				for (int j = 0; j < 4 && !four; ++j) {
+					for (int l = -4; l <= 4 && !four; ++l) {
+						auto q = pos + l * directions[j];
+						four = l != 0 && Position::valid(q) && ::std::holds_alternative<::std::monostate>(board[q]) && makesFive(board, side, q);
+					}
+				}
+				board[pos] = ::std::monostate{};
+				if (four) {
+					cells.push_back(pos);
+				}
+			}
+		}
+	}
+	return cells;
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "board.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <boost/container/static_vector.hpp>
+
+namespace tkz::gomoku::record {
+
+// A record file is a plain concatenation of games, each one a Header followed by one byte per move (the cell index,
+// black moves first), padded to a multiple of 8 bytes so that every header can be read in place from a mapping.
+
+inline constexpr ::std::array<char, 4> magic{'G', 'M', 'K', '1'};
+
+enum class Kind : ::std::uint8_t {
+	human,
+	minimax,
+	mcts,
+};
+
+enum class Result : ::std::uint8_t {
+	unfinished,
+	black,
+	white,
+};
+
+struct Config {
+	Kind kind = Kind::human;
+	::std::uint8_t neural = 0; // whether the engine evaluates with a network
+	::std::uint16_t reserved = 0;
+	::std::uint32_t strength = 0; // search depth of minimax, iterations of MCTS
+};
+
+struct Stats {
+	::std::uint32_t decisions = 0;
+	::std::uint32_t milliseconds = 0; // total thinking time
+	::std::uint64_t nodes = 0;
+};
+
+struct Header {
+	::std::array<char, 4> magic = record::magic;
+	Result result = Result::unfinished;
+	::std::uint8_t moves = 0;
+	::std::uint16_t reserved = 0;
+	::std::int64_t start = 0; // unix time in seconds
+	::std::array<Config, 2> players{}; // indexed by Side::index()
+	::std::array<Stats, 2> stats{};
+};
+
+static_assert(::std::is_trivially_copyable_v<Header> && sizeof(Header) % 8 == 0 && alignof(Header) <= 8);
+
+inline constexpr ::std::size_t padded(::std::size_t moves) { return (moves + 7) / 8 * 8; }
+
+struct Game {
+	Header header{
+		.start = ::std::chrono::duration_cast<::std::chrono::seconds>(::std::chrono::system_clock::now().time_since_epoch()).count(),
+	};
+	::boost::container::static_vector<::std::uint8_t, rows * cols> moves;
+
+	void play(Position pos) { moves.push_back(Position::toIndex(pos)); }
+
+	void retract() { moves.pop_back(); }
+
+	void finish(Result result) { header.result = result; }
+};
+
+// appends every finished game to the end of a file
+struct Writer {
+	::std::ofstream out;
+
+	explicit Writer(::std::filesystem::path const& path): out(path, ::std::ios::binary | ::std::ios::app) {
+		if (!out) {
+			throw ::std::runtime_error{"cannot open record file " + path.string()};
+		}
+	}
+
+	void append(Game const& game) {
+		Header header = game.header;
+		header.moves = game.moves.size();
+		::std::array<char, padded(rows * cols)> body{};
+		::std::ranges::copy(game.moves, body.begin());
+		out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		out.write(body.data(), padded(game.moves.size()));
+		out.flush();
+	}
+};
+
+struct View {
+	Header const* header;
+	::std::span<::std::uint8_t const> moves;
+
+	Side side(::std::size_t i) const { return i % 2 == 0 ? Side{Black{}} : Side{White{}}; }
+	Position pos(::std::size_t i) const { return Position::fromIndex(moves[i]); }
+};
+
+}
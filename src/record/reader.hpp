@@ -0,0 +1,100 @@
+#pragma once
+
+#include "record.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tkz::gomoku::record {
+
+// maps a record file and iterates over its games without copying them
+struct Reader {
+	::std::byte const* data = nullptr;
+	::std::size_t size = 0;
+
+	explicit Reader(::std::filesystem::path const& path) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw ::std::runtime_error{"cannot open record file " + path.string()};
+		}
+		struct stat status;
+		::fstat(fd, &status);
+		size = status.st_size;
+		if (size > 0) {
+			void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapping == MAP_FAILED) {
+				::close(fd);
+				throw ::std::runtime_error{"cannot map record file " + path.string()};
+			}
+			::madvise(mapping, size, MADV_SEQUENTIAL);
+			data = static_cast<::std::byte const*>(mapping);
+		}
+		::close(fd);
+	}
+
+	Reader(Reader const&) = delete;
+	Reader& operator=(Reader const&) = delete;
+
+	~Reader() {
+		if (data) {
+			::munmap(const_cast<::std::byte*>(data), size);
+		}
+	}
+
+	struct Iterator {
+		using iterator_category = ::std::forward_iterator_tag;
+		using value_type = View;
+		using difference_type = ::std::ptrdiff_t;
+
+		::std::byte const* at = nullptr;
+		::std::byte const* end = nullptr;
+
+		View operator*() const {
+			auto header = reinterpret_cast<Header const*>(at);
+			return {
+				.header = header,
+				.moves{reinterpret_cast<::std::uint8_t const*>(at + sizeof(Header)), header->moves},
+			};
+		}
+
+		// a truncated or foreign tail ends the iteration
+		static bool complete(::std::byte const* at, ::std::byte const* end) {
+			auto left = static_cast<::std::size_t>(end - at);
+			if (left < sizeof(Header)) {
+				return false;
+			}
+			auto header = reinterpret_cast<Header const*>(at);
+			return header->magic == magic && left >= sizeof(Header) + padded(header->moves);
+		}
+
+		Iterator& operator++() {
+			at += sizeof(Header) + padded(reinterpret_cast<Header const*>(at)->moves);
+			if (!complete(at, end)) {
+				at = end;
+			}
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			auto copy = *this;
+			++*this;
+			return copy;
+		}
+
+		friend bool operator==(Iterator const&, Iterator const&) = default;
+	};
+
+	Iterator begin() const {
+		return Iterator::complete(data, data + size) ? Iterator{data, data + size} : end();
+	}
+
+	Iterator end() const { return {data + size, data + size}; }
+};
+
+}
@@ -0,0 +1,26 @@
+#include "parse.hpp"
+#include "server/server.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <fmt/core.h>
+
+int main(int argc, char* argv[]) {
+	using namespace ::std;
+	using namespace ::tkz::gomoku::server;
+
+	auto threads = argc > 1 ? ::tkz::gomoku::parse<unsigned>(argv[1]) : max(1u, thread::hardware_concurrency());
+	if (!threads || *threads < 1) {
+		::fmt::println(stderr, "usage: {} [threads >= 1]", argv[0]);
+		return EXIT_FAILURE;
+	}
+	Server server{*threads};
+	for (string line; getline(cin, line);) {
+		if (!server.handle(line)) {
+			break;
+		}
+	}
+}
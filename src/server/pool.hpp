@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace tkz::gomoku::server {
+
+// fixed size thread pool, every worker owns a FIFO queue and steals the oldest task of the others when its own runs dry
+struct Pool {
+	using Task = ::std::move_only_function<void()>;
+
+	struct Queue {
+		::std::mutex mutex;
+		::std::deque<Task> tasks;
+	};
+
+	::std::vector<::std::unique_ptr<Queue>> queues;
+	::std::mutex mutex;
+	::std::condition_variable available;
+	::std::size_t pending = 0;
+	bool stopping = false;
+	::std::atomic<::std::size_t> next = 0;
+	::std::vector<::std::jthread> threads;
+
+	explicit Pool(unsigned size) {
+		assert(size > 0 && "a pool needs at least one worker");
+		for (unsigned i = 0; i < size; ++i) {
+			queues.push_back(::std::make_unique<Queue>());
+		}
+		for (unsigned i = 0; i < size; ++i) {
+			threads.emplace_back([this, i] { this->run(i); });
+		}
+	}
+
+	// runs the remaining tasks before joining the workers
+	~Pool() {
+		{
+			::std::lock_guard lock{mutex};
+			stopping = true;
+		}
+		available.notify_all();
+		threads.clear();
+	}
+
+	void submit(Task task) {
+		auto&& queue = *queues[next++ % queues.size()];
+		{
+			::std::lock_guard lock{queue.mutex};
+			queue.tasks.push_back(::std::move(task));
+		}
+		{
+			::std::lock_guard lock{mutex};
+			++pending;
+		}
+		available.notify_one();
+	}
+
+	::std::optional<Task> take(unsigned self) {
+		for (::std::size_t k = 0; k < queues.size(); ++k) {
+			auto&& queue = *queues[(self + k) % queues.size()];
+			::std::lock_guard lock{queue.mutex};
+			if (!queue.tasks.empty()) {
+				Task task = ::std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				return task;
+			}
+		}
+		return ::std::nullopt;
+	}
+
+	void run(unsigned self) {
+		while (true) {
+			{
+				::std::unique_lock lock{mutex};
+				available.wait(lock, [this] { return stopping || pending > 0; });
+				if (pending == 0) {
+					return;
+				}
+				--pending;
+			}
+			// a task has been reserved for this worker, it is in one of the queues
+			::std::optional<Task> task;
+			while (!(task = take(self))) {
+				::std::this_thread::yield();
+			}
+			(*task)();
+		}
+	}
+};
+
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "board.hpp"
+#include "player/minimax.hpp"
+#include "player/mcts.hpp"
+#include "server/pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <boost/container/static_vector.hpp>
+#include <fmt/core.h>
+
+namespace tkz::gomoku::server {
+
+struct Minimax {};
+struct MCTS {};
+
+using Engine = ::std::variant<Minimax, MCTS>;
+
+using Steps = ::boost::container::static_vector<Step, rows * cols>;
+
+// one byte per move, black always moves first
+struct Game {
+	::std::uint32_t serial;
+	Engine engine;
+	bool thinking = false;
+	bool over = false;
+	::std::chrono::milliseconds budget;
+	// evaluates with this network instead of the patterns if set
+	::std::shared_ptr<minimax::Network const> network;
+	::boost::container::static_vector<::std::uint8_t, rows * cols> moves;
+
+	Side next() const { return moves.size() % 2 == 0 ? Side{Black{}} : Side{White{}}; }
+
+	Steps steps() const {
+		Steps steps;
+		Side side = Black{};
+		for (auto index : moves) {
+			steps.push_back({ .side = side, .pos = Position::fromIndex(index) });
+			side = alter(side);
+		}
+		return steps;
+	}
+
+	Board board() const { return Board::fromSteps(steps()); }
+
+	void play(Position pos) {
+		moves.push_back(Position::toIndex(pos));
+		over = board().isWinningPos(pos) || moves.size() == rows * cols;
+	}
+};
+
+// Line based protocol, every reply starts with the game id:
+//   new <id> <minimax|mcts> <budget-ms> [network]  ->  ok <id>
+//   play <id> <x> <y>                              ->  ok <id> [over]
+//   go <id>                                        ->  move <id> <x> <y> [over], once the engine has decided
+//   end <id>                                       ->  ok <id>
+//   quit
+// Failures are answered with error <id> <reason>.
+// The budget is wall time counted from the go command, including the time it waits for a free worker.
+struct Server {
+	::std::mutex mutex; // guards games and serial
+	::std::unordered_map<int, Game> games;
+	::std::uint32_t serial = 0;
+	// networks by path, loaded once and shared by the games using them, also guarded by mutex
+	::std::unordered_map<::std::string, ::std::shared_ptr<minimax::Network const>> networks;
+	::std::mutex output;
+	Pool pool;
+
+	explicit Server(unsigned threads): pool(threads) {}
+
+	template <typename... Args>
+	void reply(::fmt::format_string<Args...> format, Args&&... args) {
+		::std::lock_guard lock{output};
+		::fmt::println(format, ::std::forward<Args>(args)...);
+		::std::fflush(stdout);
+	}
+
+	static minimax::AnyEvaluator evaluator(::std::shared_ptr<minimax::Network const> const& network) {
+		if (network) {
+			return minimax::NeuralEvaluator{network};
+		}
+		return minimax::Evaluator{};
+	}
+
+	static Operation think(::std::uint32_t serial, Engine engine, ::std::shared_ptr<minimax::Network const> const& network, Steps const& steps, ::std::chrono::steady_clock::time_point deadline) {
+		// engines are reused by the games scheduled on the same worker
+		return ::std::visit(
+			overloaded{
+				[&](Minimax) {
+					thread_local MinimaxPlayer player;
+					// killers and history assume that the previous decision was two plies earlier in the same game
+					thread_local ::std::optional<::std::uint32_t> last;
+					if (last != serial) {
+						player.forget();
+						last = serial;
+					}
+					player.eval = evaluator(network);
+					player.deadline = deadline;
+					return player.decide(steps);
+				},
+				[&](MCTS) {
+					thread_local MCTSPlayer player;
+					player.eval = evaluator(network);
+					player.deadline = deadline;
+					return player.decide(steps);
+				},
+			},
+			engine
+		);
+	}
+
+	void go(int id, Game& game) {
+		game.thinking = true;
+		auto deadline = ::std::chrono::steady_clock::now() + game.budget;
+		pool.submit([this, id, serial = game.serial, engine = game.engine, network = game.network, deadline, steps = game.steps()] {
+			Position pos = ::std::get<Position>(think(serial, engine, network, steps, deadline));
+			::std::lock_guard lock{mutex};
+			auto it = games.find(id);
+			if (it == games.end() || it->second.serial != serial) {
+				// the game has ended while thinking
+				return;
+			}
+			it->second.thinking = false;
+			it->second.play(pos);
+			reply("move {} {} {}{}", id, pos.x, pos.y, it->second.over ? " over" : "");
+		});
+	}
+
+	// returns false once the client asks to quit
+	bool handle(::std::string_view line) {
+		::std::istringstream in{::std::string{line}};
+		::std::string command;
+		int id = 0;
+		if (!(in >> command)) {
+			return true;
+		}
+		if (command == "quit") {
+			return false;
+		}
+		if (!(in >> id)) {
+			reply("error {} missing game id", id);
+			return true;
+		}
+		::std::lock_guard lock{mutex};
+		auto it = games.find(id);
+		if (command == "new") {
+			::std::string engine;
+			long long budget = 0;
+			::std::string path;
+			if (!(in >> engine >> budget) || budget <= 0 || (engine != "minimax" && engine != "mcts")) {
+				reply("error {} expected new <id> <minimax|mcts> <budget-ms> [network]", id);
+				return true;
+			}
+			if (it != games.end()) {
+				reply("error {} game already exists", id);
+				return true;
+			}
+			::std::shared_ptr<minimax::Network const> network;
+			if (in >> path) {
+				auto&& cached = networks[path];
+				try {
+					if (!cached) {
+						cached = minimax::Network::load(path);
+					}
+				}
+				catch (::std::runtime_error const& error) {
+					networks.erase(path);
+					reply("error {} {}", id, error.what());
+					return true;
+				}
+				network = cached;
+			}
+			games.emplace(id, Game{
+				.serial = serial++,
+				.engine = engine == "minimax" ? Engine{Minimax{}} : Engine{MCTS{}},
+				.budget = ::std::chrono::milliseconds{budget},
+				.network = ::std::move(network),
+			});
+			reply("ok {}", id);
+			return true;
+		}
+		if (it == games.end()) {
+			reply("error {} no such game", id);
+			return true;
+		}
+		auto&& game = it->second;
+		if (command == "end") {
+			games.erase(it);
+			reply("ok {}", id);
+		}
+		else if (game.thinking) {
+			reply("error {} engine is thinking", id);
+		}
+		else if (game.over) {
+			reply("error {} game is over", id);
+		}
+		else if (command == "play") {
+			Position pos{};
+			if (!(in >> pos.x >> pos.y) || !Position::valid(pos) || !::std::holds_alternative<::std::monostate>(game.board()[pos])) {
+				reply("error {} illegal move", id);
+			}
+			else {
+				game.play(pos);
+				reply("ok {}{}", id, game.over ? " over" : "");
+			}
+		}
+		else if (command == "go") {
+			go(id, game);
+		}
+		else {
+			reply("error {} unknown command {}", id, command);
+		}
+		return true;
+	}
+};
+
+}
@@ -0,0 +1,66 @@
+#include "board.hpp"
+#include "player/dfpn.hpp"
+#include "parse.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <fmt/core.h>
+
+// Reads one position per line as the moves "x y x y ..." played alternately from black,
+// and prints whether the side to move wins by continuous fours.
+int main(int argc, char* argv[]) {
+	using namespace ::std;
+	using namespace ::std::chrono;
+	using namespace ::tkz::gomoku;
+
+	ifstream file;
+	if (argc > 1) {
+		file.open(argv[1]);
+		if (!file) {
+			::fmt::println(stderr, "cannot open {}", argv[1]);
+			return EXIT_FAILURE;
+		}
+	}
+	istream& in = argc > 1 ? file : cin;
+	auto budget = argc > 2 ? parse<milliseconds::rep>(argv[2]) : 1000;
+	if (!budget || *budget < 1) {
+		::fmt::println(stderr, "usage: {} [positions] [budget-ms >= 1]", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	dfpn::Solver solver;
+	int number = 0;
+	for (string line; getline(in, line);) {
+		++number;
+		if (line.empty() || line.front() == '#') continue;
+		istringstream moves{line};
+		Board board;
+		Side side = Black{};
+		bool legal = true;
+		for (Position pos; legal && moves >> pos.x; side = alter(side)) {
+			legal = moves >> pos.y && Position::valid(pos) && holds_alternative<monostate>(board[pos]);
+			if (legal) {
+				board[pos] = threats::cellOf(side);
+			}
+		}
+		if (!legal || !moves.eof()) {
+			// one answer per position is still printed so that the output lines up with the input
+			::fmt::println(stderr, "line {}: illegal move", number);
+			::fmt::println("invalid");
+			continue;
+		}
+		auto start = steady_clock::now();
+		auto result = solver.solve(board, side, start + milliseconds{*budget});
+		auto time = duration_cast<milliseconds>(steady_clock::now() - start).count();
+		if (result) {
+			::fmt::println("win {} {} ({} nodes, {} ms)", result->x, result->y, solver.nodes, time);
+		}
+		else {
+			::fmt::println("unknown ({} nodes, {} ms)", solver.nodes, time);
+		}
+	}
+}
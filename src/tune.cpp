@@ -0,0 +1,70 @@
+#include "parse.hpp"
+#include "tuner/tuner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <fmt/core.h>
+
+// gomoku-tune <positions|records.gmk> [epochs] [threads]
+int main(int argc, char* argv[]) {
+	using namespace ::std;
+	using namespace ::std::chrono;
+	using namespace ::tkz::gomoku;
+
+	if (argc < 2) {
+		::fmt::println(stderr, "usage: {} <positions|records.gmk> [epochs] [threads]", argv[0]);
+		return EXIT_FAILURE;
+	}
+	filesystem::path path{argv[1]};
+	auto epochs = argc > 2 ? parse<int>(argv[2]) : 500;
+	auto threads = argc > 3 ? parse<unsigned>(argv[3]) : max(1u, thread::hardware_concurrency());
+	if (!epochs || *epochs < 1 || !threads || *threads < 1) {
+		::fmt::println(stderr, "usage: {} <positions|records.gmk> [epochs >= 1] [threads >= 1]", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	tuner::Tuner tuner{*threads};
+	auto start = steady_clock::now();
+	if (path.extension() == ".gmk") {
+		try {
+			for (auto index : tuner.load(record::Reader{path})) {
+				::fmt::println(stderr, "skipped game {}: illegal move", index);
+			}
+		}
+		catch (runtime_error const& error) {
+			::fmt::println(stderr, "{}", error.what());
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+		ifstream file{path};
+		if (!file) {
+			::fmt::println(stderr, "cannot open {}", path.string());
+			return EXIT_FAILURE;
+		}
+		for (auto number : tuner.load(file)) {
+			::fmt::println(stderr, "skipped line {}: illegal move or result", number);
+		}
+	}
+	::fmt::println("loaded {} positions in {} ms", tuner.samples.size(), duration_cast<milliseconds>(steady_clock::now() - start).count());
+	if (tuner.samples.empty()) {
+		return EXIT_FAILURE;
+	}
+
+	auto tuned = tuner.tune(minimax::Evaluator{}, *epochs, [](int epoch, double loss) {
+		if (epoch % 50 == 0 || epoch == 1) {
+			::fmt::println("epoch {}: loss {:.6f}", epoch, loss);
+		}
+	});
+	constexpr string_view names[] = { "成五", "活四", "冲四", "单活三", "条活三", "眠三", "活二", "眠二" };
+	for (size_t k = 0; k < minimax::Evaluator::patterns; ++k) {
+		::fmt::println("Score {} = {};", names[k], tuned.*minimax::Evaluator::mappings[k].first);
+	}
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "board.hpp"
+#include "player/minimax/evaluator.hpp"
+#include "player/threats.hpp"
+#include "server/pool.hpp"
+#include "record/reader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <latch>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tkz::gomoku::tuner {
+
+using minimax::Evaluator;
+
+// a labelled position reduced to the pattern counts of the side to move minus those of the other side
+struct Sample {
+	float result; // 1 win, 0.5 draw, 0 loss of the side to move
+	::std::int32_t position;
+	::std::array<::std::int16_t, Evaluator::patterns> counts;
+};
+
+// Fits the evaluator weights to game results with the logistic (Texel) loss. Weights are optimised in log space with
+// Adam, which keeps them positive and lets weights of very different magnitudes move at the same relative speed.
+struct Tuner {
+	server::Pool pool;
+	unsigned chunks;
+	::std::vector<Sample> samples;
+	double scale = 100000.0; // the score at which the side to move wins about 73% of the games
+	double rate = 0.05;
+
+	explicit Tuner(unsigned threads): pool(threads), chunks(threads * 4) {}
+
+	// runs f(begin, end, chunk) over [0, size) split into chunks on the pool and waits for all of them
+	template <typename F>
+	void parallel(::std::size_t size, F&& f) {
+		::std::latch done{static_cast<::std::ptrdiff_t>(chunks)};
+		for (unsigned chunk = 0; chunk < chunks; ++chunk) {
+			pool.submit([&, chunk] {
+				f(size * chunk / chunks, size * (chunk + 1) / chunks, chunk);
+				done.count_down();
+			});
+		}
+		done.wait();
+	}
+
+	static Sample sample(Board const& board, Side side, float result) {
+		auto ally = Evaluator::features(board, side);
+		auto enemy = Evaluator::features(board, alter(side));
+		Sample sample{ .result = result, .position = ally.position - enemy.position };
+		for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+			sample.counts[k] = ally.counts[k] - enemy.counts[k];
+		}
+		return sample;
+	}
+
+	// every line is "<result> x y x y ...", the moves played alternately from black and the result of the side to move,
+	// returns the numbers of the lines skipped for an illegal move or result
+	::std::vector<::std::size_t> load(::std::istream& in) {
+		::std::vector<::std::pair<::std::size_t, ::std::string>> lines;
+		::std::size_t number = 0;
+		for (::std::string line; ::std::getline(in, line);) {
+			++number;
+			if (!line.empty() && line.front() != '#') {
+				lines.emplace_back(number, ::std::move(line));
+			}
+		}
+		::std::size_t offset = samples.size();
+		samples.resize(offset + lines.size());
+		::std::vector<char> parsed(lines.size());
+		parallel(lines.size(), [&](::std::size_t begin, ::std::size_t end, unsigned) {
+			for (::std::size_t i = begin; i < end; ++i) {
+				::std::istringstream moves{lines[i].second};
+				Board board{};
+				Side side = Black{};
+				float result = 0.5f;
+				bool ok = (moves >> result) && 0.0f <= result && result <= 1.0f;
+				for (Position pos; ok && moves >> pos.x; side = alter(side)) {
+					ok = (moves >> pos.y) && Position::valid(pos) && ::std::holds_alternative<::std::monostate>(board[pos]);
+					if (ok) {
+						board[pos] = threats::cellOf(side);
+					}
+				}
+				parsed[i] = ok && moves.eof();
+				if (parsed[i]) {
+					samples[offset + i] = sample(board, side, result);
+				}
+			}
+		});
+		// drop the samples of the skipped lines, keeping the order of the rest
+		::std::vector<::std::size_t> skipped;
+		::std::size_t kept = offset;
+		for (::std::size_t i = 0; i < lines.size(); ++i) {
+			if (parsed[i]) {
+				samples[kept++] = samples[offset + i];
+			}
+			else {
+				skipped.push_back(lines[i].first);
+			}
+		}
+		samples.resize(kept);
+		return skipped;
+	}
+
+	// whether every move of a game is on the board and on an empty cell
+	static bool legal(record::View const& game) {
+		::std::array<bool, rows * cols> taken{};
+		return ::std::ranges::all_of(game.moves, [&](::std::uint8_t index) {
+			return index < rows * cols && !::std::exchange(taken[index], true);
+		});
+	}
+
+	// every position of the finished games in a record file, labelled with the final result,
+	// returns the indices of the games skipped for an illegal move
+	::std::vector<::std::size_t> load(record::Reader const& reader) {
+		::std::vector<record::View> games;
+		::std::vector<::std::size_t> offsets{samples.size()};
+		::std::vector<::std::size_t> skipped;
+		::std::size_t index = 0;
+		for (auto game : reader) {
+			if (!legal(game)) {
+				skipped.push_back(index);
+			}
+			else if (game.header->result != record::Result::unfinished) {
+				games.push_back(game);
+				offsets.push_back(offsets.back() + game.moves.size());
+			}
+			++index;
+		}
+		samples.resize(offsets.back());
+		parallel(games.size(), [&](::std::size_t begin, ::std::size_t end, unsigned) {
+			for (::std::size_t i = begin; i < end; ++i) {
+				auto&& game = games[i];
+				Side winner = game.header->result == record::Result::black ? Side{Black{}} : Side{White{}};
+				Board board{};
+				for (::std::size_t k = 0; k < game.moves.size(); ++k) {
+					samples[offsets[i] + k] = sample(board, game.side(k), game.side(k) == winner ? 1.0f : 0.0f);
+					board[game.pos(k)] = threats::cellOf(game.side(k));
+				}
+			}
+		});
+		return skipped;
+	}
+
+	using Weights = ::std::array<double, Evaluator::patterns>;
+
+	// mean squared error of the predicted results and its gradient with respect to the weights
+	::std::pair<double, Weights> gradient(Weights const& weights) {
+		::std::vector<::std::pair<double, Weights>> partial(chunks);
+		parallel(samples.size(), [&](::std::size_t begin, ::std::size_t end, unsigned chunk) {
+			auto&& [loss, gradient] = partial[chunk];
+			for (::std::size_t i = begin; i < end; ++i) {
+				auto&& sample = samples[i];
+				double score = sample.position;
+				for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+					score += sample.counts[k] * weights[k];
+				}
+				double p = 1.0 / (1.0 + ::std::exp(-score / scale));
+				double error = p - sample.result;
+				loss += error * error;
+				double slope = 2.0 * error * p * (1.0 - p) / scale;
+				for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+					gradient[k] += slope * sample.counts[k];
+				}
+			}
+		});
+		double loss = 0.0;
+		Weights gradient{};
+		for (auto&& [l, g] : partial) {
+			loss += l;
+			for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+				gradient[k] += g[k];
+			}
+		}
+		for (auto&& g : gradient) {
+			g /= samples.size();
+		}
+		return {loss / samples.size(), gradient};
+	}
+
+	template <typename Report>
+	Evaluator tune(Evaluator initial, int epochs, Report&& report) {
+		Weights theta, m{}, v{};
+		for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+			theta[k] = ::std::log(static_cast<double>(initial.*Evaluator::mappings[k].first));
+		}
+		constexpr double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+		for (int epoch = 1; epoch <= epochs; ++epoch) {
+			Weights weights;
+			for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+				weights[k] = ::std::exp(theta[k]);
+			}
+			auto [loss, gradient] = this->gradient(weights);
+			report(epoch, loss);
+			for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+				double g = gradient[k] * weights[k];
+				m[k] = beta1 * m[k] + (1 - beta1) * g;
+				v[k] = beta2 * v[k] + (1 - beta2) * g * g;
+				double mHat = m[k] / (1 - ::std::pow(beta1, epoch));
+				double vHat = v[k] / (1 - ::std::pow(beta2, epoch));
+				theta[k] -= rate * mHat / (::std::sqrt(vHat) + epsilon);
+			}
+		}
+		Evaluator tuned = initial;
+		for (::std::size_t k = 0; k < Evaluator::patterns; ++k) {
+			tuned.*Evaluator::mappings[k].first = ::std::lround(::std::exp(theta[k]));
+		}
+		return tuned;
+	}
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include "board.hpp"
 #include "player/base.hpp"
+#include "record.hpp"
 
 #include <cmath>
 #include <algorithm>
@@ -10,6 +11,7 @@
 #include <future>
 #include <chrono>
 #include <fmt/core.h>
+#include <fmt/format.h>
 #include <fmt/color.h>
 #include <fmt/chrono.h>
 #include <raylib.h>
@@ -26,6 +28,8 @@ inline constexpr int paddingLeft = (width - boardWidth) / 2;
 inline constexpr int paddingTop = (height - boardHeight) / 2;
 inline constexpr int pieceRadius = 15;
 inline constexpr int thick = 3;
+inline constexpr int fps = 30;
+inline constexpr ::std::chrono::milliseconds thinkingInterval{100};
 
 inline constexpr int xi2p(int i) { return paddingLeft + cellWidth * i; }
 inline constexpr int yi2p(int i) { return paddingTop + cellHeight * i; }
@@ -63,7 +67,7 @@ inline void drawGradient(Position pos, Color inner, Color outer) {
 	);
 }
 
-inline void drawBoard() {
+inline void drawBoardBackground() {
 	using namespace std;
 	ClearBackground(BEIGE);
 	DrawCircle(xi2p(3), yi2p(3), 6, DARKBROWN);
@@ -89,6 +93,19 @@ inline void drawBoard() {
 	});
 }
 
+inline void drawBoard() {
+	// the board itself never changes, render it once and blit the texture afterwards
+	static RenderTexture2D background = [] {
+		RenderTexture2D texture = LoadRenderTexture(width, height);
+		BeginTextureMode(texture);
+		drawBoardBackground();
+		EndTextureMode();
+		return texture;
+	}();
+	// render textures are stored upside down
+	DrawTextureRec(background.texture, {0, 0, width, -height}, {0, 0}, WHITE);
+}
+
 inline void drawSteps(::std::span<Step const> steps) {
 	if (steps.empty()) return;
 	for (auto&& [side, pos] : steps) {
@@ -97,10 +114,38 @@ inline void drawSteps(::std::span<Step const> steps) {
 	drawGradient(steps.back().pos, GOLD, BLANK);
 }
 
+inline void drawProgress(Progress const& progress, Side side) {
+	using namespace ::std;
+	int most = ranges::max(progress.visits);
+	if (most > 0) {
+		for (int i = 0; i < rows * cols; ++i) {
+			if (progress.visits[i] > 0) {
+				drawGradient(Position::fromIndex(i), Fade(BLUE, 0.6f * progress.visits[i] / most), BLANK);
+			}
+		}
+	}
+	for (int i = 0; i < ssize(progress.pv); ++i) {
+		Position pos = progress.pv[i];
+		Side mover = i % 2 == 0 ? side : alter(side);
+		DrawCircle(xi2p(pos.x), yi2p(pos.y), pieceRadius / 2, Fade(colorOf(mover), 0.5f));
+		DrawText(::fmt::format("{}", i + 1).c_str(), xi2p(pos.x) - 3, yi2p(pos.y) - 5, 10, RED);
+	}
+	auto text = ::fmt::format("depth {}  score {:.0f}  nodes {}  nps {:.0f}", progress.depth, progress.score, progress.nodes, progress.nps);
+	if (progress.tree.nodes > 0) {
+		text += ::fmt::format("  tree {} ({} MiB, {} recycled{})", progress.tree.nodes, progress.tree.bytes >> 20, progress.tree.recycled, progress.tree.exhausted ? ", full" : "");
+	}
+	DrawText(text.c_str(), paddingLeft, 2, 10, DARKBROWN);
+}
+
 struct UIPlayer : public Player {
 	Operation decide(::std::span<Step const> steps) override {
 		Side side = steps.empty() ? Black{} : alter(steps.back().side);
 		auto board = Board::fromSteps(steps);
+		// only wake up to redraw when an input event arrives
+		EnableEventWaiting();
+		struct Guard {
+			~Guard() { DisableEventWaiting(); }
+		} _;
 		while (!WindowShouldClose()) {
 			BeginDrawing();
 			drawBoard();
@@ -130,7 +175,10 @@ struct UIPlayer : public Player {
 
 struct AsyncPlayer : public Player {
 	::std::unique_ptr<Player> underlying;
+	// thinking time and searched nodes are added up here if set
+	record::Stats* stats = nullptr;
 	AsyncPlayer(::std::unique_ptr<Player> underlying): underlying(::std::move(underlying)) {}
+	Channel<Progress>* progress() override { return this->underlying->progress(); }
 	Operation decide(::std::span<Step const> steps) override {
 		using namespace ::std;
 		using namespace ::std::chrono;
@@ -138,13 +186,28 @@ struct AsyncPlayer : public Player {
 			return this->underlying->decide(steps);
 		});
 		auto start = steady_clock::now();
+		Side side = steps.empty() ? Black{} : alter(steps.back().side);
+		auto channel = this->progress();
+		// the board does not change while thinking, just keep the window responsive and show the search progress
 		do {
 			BeginDrawing();
 			drawBoard();
 			drawSteps(steps);
+			if (channel) {
+				channel->update();
+				drawProgress(channel->latest(), side);
+			}
 			EndDrawing();
-		} while (future.wait_for(0ms) != future_status::ready);
+		} while (future.wait_for(thinkingInterval) != future_status::ready);
 		auto end = steady_clock::now();
+		if (stats) {
+			stats->decisions += 1;
+			stats->milliseconds += duration_cast<milliseconds>(end - start).count();
+			if (channel) {
+				channel->update();
+				stats->nodes += channel->latest().nodes;
+			}
+		}
 		{
 			using namespace ::fmt;
 			println("player take {} to think the next step.",